@@ -0,0 +1,59 @@
+#pragma once
+
+// ==========================================
+// 多車頻寬排程 (Airtime Fair-Share Scheduler)
+// ==========================================
+// 純 C++ 實作，不依賴 Arduino / ESP-IDF。
+// 每台車從 mDNS TXT 取得所有車 (含自己) 的需求與設定，以 mergeConfig 合併出
+// 共用設定後用相同演算法計算配額；只要大家看到的資料一致，各自算出的結果就一致，
+// 不需要中央協調，也不需要每台車都設定相同的預算。
+//
+// 演算法：先保證每台車 min(需求, minKbps)，剩餘預算依權重做
+// water-filling (max-min fairness)，需求已滿足的車釋出的頻寬再分給其他車。
+// 被駕駛中的車權重為 drivenWeight，其他車為 1。
+
+#include <stdint.h>
+
+namespace airtime {
+
+const uint32_t STREAM_MAX_FPS = 20; // 串流畫面上限 (限速與需求估算共用)
+
+typedef struct {
+    uint32_t budgetKbps;   // 所有車共用的總頻寬預算
+    uint32_t minKbps;      // 每台車的保底頻寬
+    uint32_t drivenWeight; // 被駕駛中的車的權重
+} SchedulerConfig_t;
+
+typedef struct {
+    uint32_t demandKbps;   // 排程用的串流需求 (見 scheduledDemand)
+    bool driven;           // 是否正在被駕駛
+} CarDemand_t;
+
+// 自身要廣播、也用於排程的需求 (兩者必須相同，各車的計算才會一致)：
+// 沒有觀看者或尚未量到畫面大小時保留 minKbps 待機頻寬，
+// 新觀看者連線到下一輪排程之前，串流不會超過這個已被所有車計入的保底。
+uint32_t scheduledDemand(const SchedulerConfig_t& cfg, bool hasViewer, uint32_t measuredKbps);
+
+// 串流限速：下一張畫面最早在上一張開始後多少微秒送出，
+// 即 max(1 / maxFps, 畫面位元數 / 配額)。配額為 0 視為 1 kbps，仍須限速，不可視為不限速。
+uint32_t frameIntervalUs(uint32_t frameBytes, uint32_t capKbps, uint32_t maxFps);
+
+// 合併另一台車廣播的設定：各欄位取最小值。
+// 結果與合併順序無關，看到同一組車的每台車都得到相同的設定；
+// 各車設定都滿足 minKbps <= budgetKbps / N 時，合併結果也滿足。
+void mergeConfig(SchedulerConfig_t& merged, const SchedulerConfig_t& peer);
+
+// 被駕駛判定：最近一次手動控制距今不到 windowMs。lastControlMs 為 0 表示從未控制。
+// 以無號數相減，millis() 溢位後仍正確。
+bool isDrivenAt(uint32_t nowMs, uint32_t lastControlMs, uint32_t windowMs);
+
+// 被駕駛判定的時間窗：每輪排程只取樣一次，時間窗須涵蓋一整輪
+// (週期 + 查詢逾時 + 餘裕)，上一輪取樣後的任何一次控制都會在下一輪被看到，
+// 權重才不會因取樣時間點落在兩次搖桿輸入之間而忽有忽無。
+uint32_t drivenWindowMs(uint32_t periodMs, uint32_t queryTimeoutMs);
+
+// 計算 count 台車的配額，結果寫入 capKbps[0..count-1]。
+// 結果與 cars 的排列順序無關；配額總和不超過 budgetKbps。
+void allocate(const SchedulerConfig_t& cfg, const CarDemand_t* cars, int count, uint32_t* capKbps);
+
+} // namespace airtime
@@ -0,0 +1,53 @@
+#pragma once
+
+// ==========================================
+// 循線視覺核心 (Line-Following Vision Kernels)
+// ==========================================
+// 純 C++ 實作，不依賴 Arduino / ESP-IDF，可直接在 Linux 上編譯驗證。
+// 每個核心都有 scalar 與 SWAR (一次處理 4 個像素的 32-bit 向量化) 兩種版本，
+// 兩者輸出逐位元相同，方便以錄製的畫面做 golden 比對。
+//
+// 影像格式：8-bit 灰階，row-major，stride == width。
+// 二值化遮罩：每個像素 1 byte，值為 0 或 1 (1 = 線條)。
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace linevision {
+
+// 單列掃描結果
+typedef struct {
+    int count;     // 線條像素數
+    int32_t sumX;  // 線條像素 x 座標總和
+} RowScan_t;
+
+// 整張畫面的循線結果
+typedef struct {
+    bool found;       // 是否有足夠的列偵測到線條
+    float offset;     // 線條重心偏移，-1.0 (最左) ~ 1.0 (最右)
+    int rowsWithLine; // 偵測到線條的掃描列數
+} LineResult_t;
+
+// RGB565 轉灰階：little-endian (低位元組在前)，與 esp32-camera jpg2rgb565 (to_bmp.c _rgb565_write) 的輸出相同
+void rgb565ToGray(const uint8_t* src, size_t pixels, uint8_t* dst);
+
+// 全畫面平均亮度，作為自適應二值化門檻的基準
+uint8_t meanLuma(const uint8_t* src, size_t pixels);
+
+// 2x2 縮小：dst 大小為 (w/2) x (h/2)，w 與 h 須為偶數
+// 取樣方式為 avg(avg(上左, 下左), avg(上右, 下右))，各步驟無條件捨去
+void downscale2xScalar(const uint8_t* src, int w, int h, uint8_t* dst);
+void downscale2xSwar(const uint8_t* src, int w, int h, uint8_t* dst);
+
+// 二值化：darkLine 為 true 時 (白底黑線) 亮度 < thr 視為線條，否則亮度 >= thr 視為線條
+void thresholdScalar(const uint8_t* src, size_t n, uint8_t thr, bool darkLine, uint8_t* mask);
+void thresholdSwar(const uint8_t* src, size_t n, uint8_t thr, bool darkLine, uint8_t* mask);
+
+// 單列掃描：統計遮罩中線條像素數與 x 座標總和
+RowScan_t rowScanScalar(const uint8_t* maskRow, int width);
+RowScan_t rowScanSwar(const uint8_t* maskRow, int width);
+
+// 由下往上每隔 rowStep 列掃描 rows 列，下方 (靠近車頭) 的列權重較高
+LineResult_t findLine(const uint8_t* mask, int w, int h, int rows, int rowStep, bool useSwar);
+
+} // namespace linevision
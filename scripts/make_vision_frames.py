@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+# Regenerate the QQVGA (160x120) test frames and golden outputs used by
+# test/native/test_line_vision.
+#
+# Frames are written as RGB565 in the byte order esp32-camera's jpg2rgb565
+# produces (_rgb565_write in conversions/to_bmp.c: low byte first), so the
+# native tests run the same bytes the vision task sees after JPEG decode.
+#
+# The golden outputs come from an independent Python port of the pipeline
+# (gray -> 2x downscale -> mean-bias threshold -> row scan), not from the C++
+# kernels under test.
+#
+# Usage: python3 scripts/make_vision_frames.py   (writes into test/data/)
+import math
+import os
+import random
+
+W, H = 160, 120
+SCAN_ROWS, ROW_STEP = 8, 4      # VISION_SCAN_ROWS / VISION_ROW_STEP in main.cpp
+BIAS, DARK_LINE = 30, True      # autoConfig defaults in main.cpp
+
+OUT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "test", "data")
+
+
+def clamp8(v):
+    return max(0, min(255, int(round(v))))
+
+
+def scene_straight(rng):
+    # Dark tape right of center on a warm floor, with sensor noise and vignette.
+    px = []
+    for y in range(H):
+        for x in range(W):
+            vig = 1.0 - 0.12 * (((x - W / 2) / (W / 2)) ** 2 + ((y - H / 2) / (H / 2)) ** 2)
+            if 96 <= x < 106:
+                rgb = (40, 40, 50)
+            else:
+                rgb = (200 * vig, 190 * vig, 170 * vig)
+            n = rng.randint(-12, 12)
+            px.append(tuple(clamp8(c + n) for c in rgb))
+    return px
+
+
+def scene_curve(rng):
+    # Tape curving left toward the horizon under a left-to-right lighting gradient.
+    px = []
+    for y in range(H):
+        t = (H - 1 - y) / (H - 1)
+        cx = 84 - 55 * t * t
+        for x in range(W):
+            light = 0.65 + 0.35 * x / (W - 1)
+            if abs(x - cx) < 6:
+                rgb = (35, 35, 45)
+            else:
+                rgb = (210 * light, 200 * light, 185 * light)
+            n = rng.randint(-10, 10)
+            px.append(tuple(clamp8(c + n) for c in rgb))
+    return px
+
+
+def scene_lost(rng):
+    # Floor only, with a specular glare spot: no line must be reported.
+    px = []
+    for y in range(H):
+        for x in range(W):
+            glare = 60 * math.exp(-((x - 50) ** 2 + (y - 40) ** 2) / 300.0)
+            n = rng.randint(-12, 12)
+            px.append(tuple(clamp8(c + glare + n) for c in (190, 185, 175)))
+    return px
+
+
+def to_rgb565_le(px):
+    out = bytearray()
+    for r, g, b in px:
+        c = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+        out += bytes((c & 0xFF, c >> 8))
+    return out
+
+
+def gray_from_rgb565_le(buf):
+    gray = []
+    for i in range(0, len(buf), 2):
+        c = buf[i] | (buf[i + 1] << 8)
+        r = (c >> 8) & 0xF8
+        g = (c >> 3) & 0xFC
+        b = (c << 3) & 0xF8
+        gray.append((77 * r + 150 * g + 29 * b) >> 8)
+    return gray
+
+
+def downscale2x(gray, w, h):
+    avg = lambda a, b: (a + b) >> 1
+    out = []
+    for y in range(h // 2):
+        for x in range(w // 2):
+            tl, tr = gray[2 * y * w + 2 * x], gray[2 * y * w + 2 * x + 1]
+            bl, br = gray[(2 * y + 1) * w + 2 * x], gray[(2 * y + 1) * w + 2 * x + 1]
+            out.append(avg(avg(tl, bl), avg(tr, br)))
+    return out
+
+
+def find_line(mask, w, h):
+    weighted, total, rows_with_line = 0.0, 0.0, 0
+    for i in range(SCAN_ROWS):
+        y = h - 1 - i * ROW_STEP
+        if y < 0:
+            break
+        xs = [x for x in range(w) if mask[y * w + x]]
+        if not xs or len(xs) > w // 2:
+            continue
+        weight = SCAN_ROWS - i
+        weighted += weight * (sum(xs) / len(xs))
+        total += weight
+        rows_with_line += 1
+    if total > 0 and rows_with_line * 4 >= SCAN_ROWS:
+        center = (w - 1) * 0.5
+        return True, (weighted / total - center) / center, rows_with_line
+    return False, 0.0, rows_with_line
+
+
+def main():
+    os.makedirs(OUT_DIR, exist_ok=True)
+    scenes = [("straight", scene_straight), ("curve", scene_curve), ("lost", scene_lost)]
+    for seed, (name, fn) in enumerate(scenes):
+        rgb565 = to_rgb565_le(fn(random.Random(seed)))
+        small = downscale2x(gray_from_rgb565_le(rgb565), W, H)
+        sw, sh = W // 2, H // 2
+        mean = sum(small) // len(small)
+        thr = max(0, min(255, mean - BIAS if DARK_LINE else mean + BIAS))
+        mask = [(0 if v >= thr else 1) if DARK_LINE else (1 if v >= thr else 0) for v in small]
+        found, offset, rows = find_line(mask, sw, sh)
+
+        base = os.path.join(OUT_DIR, name)
+        with open(base + ".rgb565", "wb") as f:
+            f.write(rgb565)
+        with open(base + ".small", "wb") as f:
+            f.write(bytes(small))
+        with open(base + ".mask", "wb") as f:
+            f.write(bytes(mask))
+        with open(base + ".golden", "w") as f:
+            f.write("thr %d\nfound %d\noffset %.6f\nrows %d\n" % (thr, int(found), offset, rows))
+        print("%-8s thr=%3d found=%d offset=%+.4f rows=%d" % (name, thr, found, offset, rows))
+
+
+if __name__ == "__main__":
+    main()
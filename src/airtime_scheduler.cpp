@@ -0,0 +1,97 @@
+#include "airtime_scheduler.h"
+
+namespace airtime {
+
+static const uint32_t UNSETTLED = 0xFFFFFFFFu;
+static const uint32_t DRIVEN_WINDOW_MARGIN_MS = 1000; // 廣播、排程本身與排程器延遲
+
+static inline uint32_t minU32(uint32_t a, uint32_t b) {
+    return a < b ? a : b;
+}
+
+static inline uint64_t weightOf(const SchedulerConfig_t& cfg, const CarDemand_t& car) {
+    return (car.driven && cfg.drivenWeight > 0) ? cfg.drivenWeight : 1;
+}
+
+uint32_t scheduledDemand(const SchedulerConfig_t& cfg, bool hasViewer, uint32_t measuredKbps) {
+    if (!hasViewer || measuredKbps == 0) return cfg.minKbps;
+    return measuredKbps;
+}
+
+uint32_t frameIntervalUs(uint32_t frameBytes, uint32_t capKbps, uint32_t maxFps) {
+    uint64_t fpsUs = 1000000 / (maxFps ? maxFps : 1);
+    uint64_t capUs = (uint64_t)frameBytes * 8 * 1000 / (capKbps ? capKbps : 1); // bits * 1000 / kbps = us
+    uint64_t intervalUs = capUs > fpsUs ? capUs : fpsUs;
+    return intervalUs > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)intervalUs;
+}
+
+void mergeConfig(SchedulerConfig_t& merged, const SchedulerConfig_t& peer) {
+    merged.budgetKbps = minU32(merged.budgetKbps, peer.budgetKbps);
+    merged.minKbps = minU32(merged.minKbps, peer.minKbps);
+    merged.drivenWeight = minU32(merged.drivenWeight, peer.drivenWeight);
+}
+
+bool isDrivenAt(uint32_t nowMs, uint32_t lastControlMs, uint32_t windowMs) {
+    return lastControlMs != 0 && nowMs - lastControlMs < windowMs;
+}
+
+uint32_t drivenWindowMs(uint32_t periodMs, uint32_t queryTimeoutMs) {
+    return periodMs + queryTimeoutMs + DRIVEN_WINDOW_MARGIN_MS;
+}
+
+void allocate(const SchedulerConfig_t& cfg, const CarDemand_t* cars, int count, uint32_t* capKbps) {
+    if (count <= 0) return;
+
+    // 1. 保底：每台車先拿 min(需求, minKbps)
+    uint64_t baseSum = 0;
+    for (int i = 0; i < count; i++) baseSum += minU32(cars[i].demandKbps, cfg.minKbps);
+
+    // 預算連保底都不夠時，平均分配 (不超過需求)
+    if (baseSum > cfg.budgetKbps) {
+        uint32_t equal = cfg.budgetKbps / (uint32_t)count;
+        for (int i = 0; i < count; i++) capKbps[i] = minU32(cars[i].demandKbps, equal);
+        return;
+    }
+
+    // 2. 剩餘預算依權重 water-filling
+    uint64_t remaining = cfg.budgetKbps - baseSum;
+    for (int i = 0; i < count; i++) capKbps[i] = UNSETTLED;
+
+    while (true) {
+        uint64_t totalWeight = 0;
+        for (int i = 0; i < count; i++) {
+            if (capKbps[i] == UNSETTLED) totalWeight += weightOf(cfg, cars[i]);
+        }
+        if (totalWeight == 0) break; // 全部已滿足
+
+        // 需求低於份額的車直接滿足，釋出的頻寬留給下一輪。
+        // 份額以本輪開始時的 remaining 計算，結果與車的排列順序無關。
+        uint64_t released = 0;
+        bool settledAny = false;
+        for (int i = 0; i < count; i++) {
+            if (capKbps[i] != UNSETTLED) continue;
+            uint32_t base = minU32(cars[i].demandKbps, cfg.minKbps);
+            uint32_t extraDemand = cars[i].demandKbps - base;
+            uint64_t weight = weightOf(cfg, cars[i]);
+            uint64_t share = remaining * weight / totalWeight;
+            if (extraDemand <= share) {
+                capKbps[i] = cars[i].demandKbps;
+                released += extraDemand;
+                settledAny = true;
+            }
+        }
+        remaining -= released;
+        if (settledAny) continue;
+
+        // 其餘的車需求都超過份額，依權重分完剩餘預算
+        for (int i = 0; i < count; i++) {
+            if (capKbps[i] != UNSETTLED) continue;
+            uint32_t base = minU32(cars[i].demandKbps, cfg.minKbps);
+            uint64_t weight = weightOf(cfg, cars[i]);
+            capKbps[i] = base + (uint32_t)(remaining * weight / totalWeight);
+        }
+        break;
+    }
+}
+
+} // namespace airtime
@@ -0,0 +1,193 @@
+#include "line_vision.h"
+
+#include <string.h>
+
+// SWAR 版本假設 little-endian (ESP32-S3 與 x86/ARM Linux 皆是)，
+// 其他平台直接退回 scalar 版本以保持結果一致。
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define LINE_VISION_SWAR 1
+#else
+#define LINE_VISION_SWAR 0
+#endif
+
+namespace linevision {
+
+// --- 共用工具 ---
+static const uint32_t LANE_HI = 0x80808080u;   // 每個 byte 的最高位
+static const uint32_t LANE_ONE = 0x01010101u;  // 每個 byte 為 1
+
+static inline uint32_t load32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v)); // 編譯後為單一 load，亦可處理未對齊位址
+    return v;
+}
+
+static inline void store32(uint8_t* p, uint32_t v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline uint8_t avg8(uint8_t a, uint8_t b) {
+    return (uint8_t)((a + b) >> 1);
+}
+
+// 逐 byte 無條件捨去平均，byte 之間不會進位
+static inline uint32_t avg8x4(uint32_t a, uint32_t b) {
+    return (a & b) + (((a ^ b) & 0xFEFEFEFEu) >> 1);
+}
+
+// ==========================================
+// 色彩轉換 / 統計
+// ==========================================
+void rgb565ToGray(const uint8_t* src, size_t pixels, uint8_t* dst) {
+    for (size_t i = 0; i < pixels; i++) {
+        uint16_t c = (uint16_t)(src[2 * i] | (src[2 * i + 1] << 8));
+        uint32_t r = (c >> 8) & 0xF8;
+        uint32_t g = (c >> 3) & 0xFC;
+        uint32_t b = (c << 3) & 0xF8;
+        // BT.601 近似：Y = (77R + 150G + 29B) / 256
+        dst[i] = (uint8_t)((77 * r + 150 * g + 29 * b) >> 8);
+    }
+}
+
+uint8_t meanLuma(const uint8_t* src, size_t pixels) {
+    if (pixels == 0) return 0;
+    uint32_t sum = 0;
+    for (size_t i = 0; i < pixels; i++) sum += src[i];
+    return (uint8_t)(sum / pixels);
+}
+
+// ==========================================
+// 2x2 縮小
+// ==========================================
+void downscale2xScalar(const uint8_t* src, int w, int h, uint8_t* dst) {
+    const int ow = w / 2;
+    for (int y = 0; y < h / 2; y++) {
+        const uint8_t* top = src + (2 * y) * w;
+        const uint8_t* bot = top + w;
+        uint8_t* out = dst + y * ow;
+        for (int x = 0; x < ow; x++) {
+            out[x] = avg8(avg8(top[2 * x], bot[2 * x]), avg8(top[2 * x + 1], bot[2 * x + 1]));
+        }
+    }
+}
+
+void downscale2xSwar(const uint8_t* src, int w, int h, uint8_t* dst) {
+#if LINE_VISION_SWAR
+    const int ow = w / 2;
+    for (int y = 0; y < h / 2; y++) {
+        const uint8_t* top = src + (2 * y) * w;
+        const uint8_t* bot = top + w;
+        uint8_t* out = dst + y * ow;
+        int x = 0;
+        // 每次讀 4 個來源像素，輸出 2 個像素
+        for (; x + 4 <= 2 * ow; x += 4) {
+            uint32_t v = avg8x4(load32(top + x), load32(bot + x)); // 垂直平均
+            uint32_t m = avg8x4(v, v >> 8);                          // 水平平均 (byte 0 與 byte 2 有效)
+            out[x / 2] = (uint8_t)m;
+            out[x / 2 + 1] = (uint8_t)(m >> 16);
+        }
+        for (; x < 2 * ow; x += 2) {
+            out[x / 2] = avg8(avg8(top[x], bot[x]), avg8(top[x + 1], bot[x + 1]));
+        }
+    }
+#else
+    downscale2xScalar(src, w, h, dst);
+#endif
+}
+
+// ==========================================
+// 二值化
+// ==========================================
+void thresholdScalar(const uint8_t* src, size_t n, uint8_t thr, bool darkLine, uint8_t* mask) {
+    for (size_t i = 0; i < n; i++) {
+        uint8_t bright = src[i] >= thr;
+        mask[i] = darkLine ? (uint8_t)(bright ^ 1) : bright;
+    }
+}
+
+void thresholdSwar(const uint8_t* src, size_t n, uint8_t thr, bool darkLine, uint8_t* mask) {
+#if LINE_VISION_SWAR
+    const uint32_t t = thr * LANE_ONE;
+    const uint32_t flip = darkLine ? LANE_ONE : 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t x = load32(src + i);
+        // 逐 byte 無號比較 x >= t：先比較低 7 位元，再以最高位修正
+        uint32_t lo = (x | LANE_HI) - (t & ~LANE_HI);
+        uint32_t ge = ((x & ~t) | (~(x ^ t) & lo)) & LANE_HI;
+        store32(mask + i, (ge >> 7) ^ flip);
+    }
+    if (i < n) thresholdScalar(src + i, n - i, thr, darkLine, mask + i);
+#else
+    thresholdScalar(src, n, thr, darkLine, mask);
+#endif
+}
+
+// ==========================================
+// 列掃描 / 重心
+// ==========================================
+RowScan_t rowScanScalar(const uint8_t* maskRow, int width) {
+    RowScan_t r = {0, 0};
+    for (int x = 0; x < width; x++) {
+        if (maskRow[x]) {
+            r.count++;
+            r.sumX += x;
+        }
+    }
+    return r;
+}
+
+RowScan_t rowScanSwar(const uint8_t* maskRow, int width) {
+#if LINE_VISION_SWAR
+    RowScan_t r = {0, 0};
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        uint32_t m = load32(maskRow + x);
+        if (!m) continue;
+        // 遮罩為 0/1，乘法後最高 byte 即為 4 個 lane 的 (數量) 與 (lane 索引加權和)
+        int cnt = (int)((m * LANE_ONE) >> 24);
+        int idx = (int)((m * 0x00010203u) >> 24);
+        r.count += cnt;
+        r.sumX += x * cnt + idx;
+    }
+    for (; x < width; x++) {
+        if (maskRow[x]) {
+            r.count++;
+            r.sumX += x;
+        }
+    }
+    return r;
+#else
+    return rowScanScalar(maskRow, width);
+#endif
+}
+
+LineResult_t findLine(const uint8_t* mask, int w, int h, int rows, int rowStep, bool useSwar) {
+    LineResult_t result = {false, 0.0f, 0};
+    if (w < 2 || h < 1 || rows < 1 || rowStep < 1) return result;
+
+    float weightedX = 0.0f;
+    float totalWeight = 0.0f;
+    for (int i = 0; i < rows; i++) {
+        int y = h - 1 - i * rowStep;
+        if (y < 0) break;
+        RowScan_t r = useSwar ? rowScanSwar(mask + y * w, w) : rowScanScalar(mask + y * w, w);
+        // 整列幾乎都是線條多半是反光或門檻錯誤，不採用
+        if (r.count == 0 || r.count > w / 2) continue;
+
+        float weight = (float)(rows - i);
+        weightedX += weight * ((float)r.sumX / r.count);
+        totalWeight += weight;
+        result.rowsWithLine++;
+    }
+
+    // 至少 1/4 的掃描列看到線條才視為有效
+    if (totalWeight > 0.0f && result.rowsWithLine * 4 >= rows) {
+        float center = (w - 1) * 0.5f;
+        result.found = true;
+        result.offset = (weightedX / totalWeight - center) / center;
+    }
+    return result;
+}
+
+} // namespace linevision
@@ -10,6 +10,9 @@
 // --- 新增：相機與串流庫 ---
 #include "esp_camera.h"
 #include "esp_http_server.h"
+#include "img_converters.h"
+#include "line_vision.h"
+#include "airtime_scheduler.h"
 
 #include <BLEDevice.h>
 #include <BLEServer.h>
@@ -81,6 +84,7 @@ Preferences preferences;
 MotorConfig_t motorConfig;           
 
 volatile unsigned long lastControlTime = 0; 
+volatile unsigned long lastDriveTime = 0;  // 最後一次手動控制 (頻寬排程的被駕駛判定，不含自動循線)
 volatile int targetSpeedT = 0;             
 volatile int currentSpeedT = 0;            
 volatile int targetSpeedS = 0;             
@@ -133,12 +137,13 @@ bool initCamera() {
     config.pin_reset = RESET_GPIO_NUM;
     config.xclk_freq_hz = 10000000;       // 10MHz 穩定性較高
     config.pixel_format = PIXFORMAT_JPEG; 
+    config.grab_mode = CAMERA_GRAB_LATEST; // 串流限速時跳過舊畫面，避免延遲累積
 
     // S3 通常有 PSRAM，使用它來獲得更好的緩衝
     if(psramFound()){
         config.frame_size = FRAMESIZE_VGA;
         config.jpeg_quality = 10;
-        config.fb_count = 2;
+        config.fb_count = 3;              // 串流與循線任務同時取用畫面
     } else {
         config.frame_size = FRAMESIZE_QVGA;
         config.jpeg_quality = 12;
@@ -179,6 +184,40 @@ bool initCamera() {
     return true;
 }
 
+// --- 串流限速 (配額由 3.6 的頻寬排程計算) ---
+volatile bool streamScheduled = false;    // false = 尚未排程 (mDNS 未啟動)，只受 airtime::STREAM_MAX_FPS 限制
+volatile uint32_t streamCapKbps = 0;      // 排程後的配額，streamScheduled 為 true 時才有效
+volatile uint32_t streamRateKbps = 0;     // 最近 1 秒實際送出的位元率
+volatile uint32_t streamFrameBytes = 0;   // 畫面大小的移動平均
+volatile int streamClients = 0;
+TaskHandle_t airtimeTaskHandle = NULL;    // 第一位觀看者連線時喚醒排程 (見 3.6)
+
+// 統計畫面大小與實際位元率
+void recordStreamFrame(size_t frameLen) {
+    static uint32_t windowStartMs = 0;
+    static uint32_t windowBytes = 0;
+
+    streamFrameBytes = streamFrameBytes ? (streamFrameBytes * 7 + frameLen) / 8 : frameLen;
+
+    windowBytes += frameLen;
+    uint32_t now = millis();
+    if (now - windowStartMs >= 1000) {
+        streamRateKbps = windowBytes * 8 / (now - windowStartMs);
+        windowStartMs = now;
+        windowBytes = 0;
+    }
+}
+
+// 依配額決定下一張畫面的最早送出時間
+void paceStream(size_t frameLen, uint32_t frameStartUs) {
+    uint32_t intervalUs = streamScheduled
+        ? airtime::frameIntervalUs(frameLen, streamCapKbps, airtime::STREAM_MAX_FPS)
+        : 1000000 / airtime::STREAM_MAX_FPS;
+
+    uint32_t elapsedUs = micros() - frameStartUs;
+    if (elapsedUs < intervalUs) vTaskDelay(pdMS_TO_TICKS((intervalUs - elapsedUs) / 1000));
+}
+
 // 串流處理函式 (運行於 Port 81)
 esp_err_t stream_handler(httpd_req_t *req) {
     camera_fb_t * fb = NULL;
@@ -188,7 +227,9 @@ esp_err_t stream_handler(httpd_req_t *req) {
     res = httpd_resp_set_type(req, "multipart/x-mixed-replace;boundary=frame");
     if(res != ESP_OK) return res;
 
+    bool firstViewer = streamClients++ == 0;
     while(true) {
+        uint32_t frameStartUs = micros();
         fb = esp_camera_fb_get();
         if (!fb) {
             res = ESP_FAIL;
@@ -201,12 +242,22 @@ esp_err_t stream_handler(httpd_req_t *req) {
         if(res == ESP_OK) res = httpd_resp_send_chunk(req, "\r\n", 2);
 
         if(fb) {
+            size_t frameLen = fb->len;
             esp_camera_fb_return(fb);
             fb = NULL;
+            if(res != ESP_OK) break; // 用戶端斷線
+            recordStreamFrame(frameLen);
+            if (firstViewer) {
+                // 待機時只排到 minKbps：量到畫面大小後立刻重新排程，不等下一輪
+                firstViewer = false;
+                if (airtimeTaskHandle) xTaskNotifyGive(airtimeTaskHandle);
+            }
+            paceStream(frameLen, frameStartUs);
         } else if(res != ESP_OK) {
             break;
         }
     }
+    streamClients--;
     return res;
 }
 
@@ -228,6 +279,336 @@ void startCameraServer() {
     }
 }
 
+// ==========================================
+// 3.5 自動循線模式 (車上閉迴路，不經 Wi-Fi)
+// ==========================================
+// 流程：JPEG 以 1/4 比例解碼 → 灰階 → 2x 縮小 → 二值化 → 由下往上列掃描 → 設定 targetSpeedT/S
+// 假設鏡頭朝前下方，畫面下緣即車頭前方的地面。
+const int VISION_PERIOD_MS = 50;          // 20 FPS 控制迴圈
+// 每張畫面取得後的處理時間 (JPEG 解碼 + 核心) 上限，超過則丟棄結果。
+// 依控制週期而非單看解碼時間訂定：VGA 以 1/4 比例解碼最多約 20 ms、核心約 1 ms，
+// 40 ms 留下約 2 倍餘裕，正常畫面不會被誤判超時；又小於 50 ms 週期，
+// 套用的結果不會晚於下一張畫面。
+const uint32_t VISION_BUDGET_US = 40000;
+const int VISION_SCAN_ROWS = 8;           // 掃描列數
+const int VISION_ROW_STEP = 4;            // 掃描列間距 (縮小後的像素)
+const int VISION_MAX_DECODE_PIXELS = 160 * 120; // VGA 以 1/4 比例解碼後的大小
+
+typedef struct {
+    int cruiseSpeed;    // 直線巡航油門
+    int minSpeed;       // 最大轉向時的油門
+    float steerGain;    // 偏移 (-1.0 ~ 1.0) → 轉向比例
+    float steerDeadband; // 偏移小於此值不轉向
+    int thresholdBias;  // 二值化門檻 = 平均亮度 -/+ bias
+    bool darkLine;      // true: 白底黑線, false: 黑底白線
+    bool useSwar;       // true: 使用 SWAR 向量化核心
+} AutoConfig_t;
+
+AutoConfig_t autoConfig = {
+    .cruiseSpeed = 180, .minSpeed = 120,
+    .steerGain = 1.5f, .steerDeadband = 0.1f,
+    .thresholdBias = 30, .darkLine = true, .useSwar = true
+};
+portMUX_TYPE autoConfigMux = portMUX_INITIALIZER_UNLOCKED; // /auto 寫入、visionTask 讀取
+
+volatile bool autoMode = false;
+// autoMode 與 targetSpeedT/S、lastControlTime 必須一起更新：
+// 否則 visionTask (core 0) 可能在手動接管或停用之後，以巡航速度蓋掉停車指令
+portMUX_TYPE controlMux = portMUX_INITIALIZER_UNLOCKED;
+
+// 手動控制 (/control、BLE)：接管自動模式並設定目標速度
+void setManualControl(int speedT, int speedS) {
+    unsigned long now = millis();
+    taskENTER_CRITICAL(&controlMux);
+    autoMode = false;
+    targetSpeedT = speedT;
+    targetSpeedS = speedS;
+    lastControlTime = now;
+    lastDriveTime = now;
+    taskEXIT_CRITICAL(&controlMux);
+}
+
+// 切換模式時先停車
+void setAutoMode(bool enabled) {
+    taskENTER_CRITICAL(&controlMux);
+    autoMode = enabled;
+    targetSpeedT = 0;
+    targetSpeedS = 0;
+    taskEXIT_CRITICAL(&controlMux);
+}
+
+// --- 循線統計 (供 /auto 查詢) ---
+volatile uint32_t visionFrames = 0;
+volatile uint32_t visionOverruns = 0;
+volatile uint32_t visionWaitUs = 0;    // 最後一張畫面等待取像的時間 (不計入預算)
+volatile uint32_t visionDecodeUs = 0;  // 最後一張畫面 JPEG 解碼時間
+volatile uint32_t visionTotalUs = 0;   // 最後一張畫面取得後的處理時間 (解碼 + 核心)
+volatile uint32_t visionKernelUs = 0;  // 最後一張畫面核心時間 (灰階 → 列掃描)
+volatile float visionOffset = 0.0f;
+volatile bool visionLineFound = false;
+
+// 每張畫面取一次設定快照，避免處理途中被 /auto 修改
+AutoConfig_t getAutoConfig() {
+    taskENTER_CRITICAL(&autoConfigMux);
+    AutoConfig_t cfg = autoConfig;
+    taskEXIT_CRITICAL(&autoConfigMux);
+    return cfg;
+}
+
+void setAutoConfig(AutoConfig_t cfg) {
+    // 油門不可超過馬達上限也不可倒車，轉彎時不可比直線快
+    cfg.cruiseSpeed = constrain(cfg.cruiseSpeed, 0, motorConfig.pwmEffectiveLimitT);
+    cfg.minSpeed = constrain(cfg.minSpeed, 0, cfg.cruiseSpeed);
+    if (!(cfg.steerGain >= 0.0f)) cfg.steerGain = 0.0f; // 含 NaN
+    cfg.steerGain = constrain(cfg.steerGain, 0.0f, 10.0f);
+    cfg.thresholdBias = constrain(cfg.thresholdBias, 0, 255);
+
+    taskENTER_CRITICAL(&autoConfigMux);
+    autoConfig = cfg;
+    taskEXIT_CRITICAL(&autoConfigMux);
+}
+
+void applyLineResult(const linevision::LineResult_t& line, const AutoConfig_t& cfg) {
+    visionLineFound = line.found;
+    visionOffset = line.offset;
+
+    // 看不到線就停車
+    int speedT = 0, speedS = 0;
+    if (line.found) {
+        float steer = constrain(line.offset * cfg.steerGain, -1.0f, 1.0f);
+        if (fabsf(line.offset) < cfg.steerDeadband) steer = 0.0f;
+
+        speedT = cfg.cruiseSpeed - (int)((cfg.cruiseSpeed - cfg.minSpeed) * fabsf(steer));
+        speedS = (int)(steer * motorConfig.pwmEffectiveLimitS);
+        speedT = constrain(speedT, -motorConfig.pwmEffectiveLimitT, motorConfig.pwmEffectiveLimitT);
+        speedS = constrain(speedS, -motorConfig.pwmEffectiveLimitS, motorConfig.pwmEffectiveLimitS);
+    }
+
+    // 處理期間可能已被手動接管或停用：檢查與寫入在同一個臨界區內完成
+    unsigned long now = millis();
+    taskENTER_CRITICAL(&controlMux);
+    if (autoMode) {
+        targetSpeedT = speedT;
+        targetSpeedS = speedS;
+        lastControlTime = now;
+    }
+    taskEXIT_CRITICAL(&controlMux);
+}
+
+void visionTask(void* param) {
+    const size_t n = VISION_MAX_DECODE_PIXELS;
+    uint8_t* rgb = (uint8_t*)(psramFound() ? ps_malloc(n * 2) : malloc(n * 2));
+    uint8_t* gray = (uint8_t*)malloc(n);
+    uint8_t* small = (uint8_t*)malloc(n / 4);
+    uint8_t* mask = (uint8_t*)malloc(n / 4);
+    if (!rgb || !gray || !small || !mask) {
+        Serial.println("❌ Vision buffer alloc failed");
+        free(rgb); free(gray); free(small); free(mask);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    TickType_t lastWake = xTaskGetTickCount();
+    while (true) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(VISION_PERIOD_MS));
+        if (!autoMode) continue;
+
+        uint32_t waitStart = micros();
+        camera_fb_t* fb = esp_camera_fb_get();
+        if (!fb) continue;
+        // 預算從取得畫面開始計算，與串流共用畫面佇列時的等待時間另外統計
+        uint32_t t0 = micros();
+        visionWaitUs = t0 - waitStart;
+        int w = (fb->width / 4) & ~1;
+        int h = (fb->height / 4) & ~1;
+        bool decoded = fb->format == PIXFORMAT_JPEG && w * h <= VISION_MAX_DECODE_PIXELS
+                       && jpg2rgb565(fb->buf, fb->len, rgb, JPG_SCALE_4X);
+        esp_camera_fb_return(fb);
+        if (!decoded) continue;
+
+        uint32_t t1 = micros();
+        AutoConfig_t cfg = getAutoConfig();
+        bool swar = cfg.useSwar;
+        int sw = w / 2, sh = h / 2;
+        linevision::rgb565ToGray(rgb, w * h, gray);
+        if (swar) linevision::downscale2xSwar(gray, w, h, small);
+        else linevision::downscale2xScalar(gray, w, h, small);
+
+        int luma = linevision::meanLuma(small, sw * sh);
+        int thr = constrain(cfg.darkLine ? luma - cfg.thresholdBias : luma + cfg.thresholdBias, 0, 255);
+        if (swar) linevision::thresholdSwar(small, sw * sh, thr, cfg.darkLine, mask);
+        else linevision::thresholdScalar(small, sw * sh, thr, cfg.darkLine, mask);
+
+        linevision::LineResult_t line = linevision::findLine(mask, sw, sh, VISION_SCAN_ROWS, VISION_ROW_STEP, swar);
+        uint32_t t2 = micros();
+
+        visionDecodeUs = t1 - t0;
+        visionKernelUs = t2 - t1;
+        visionTotalUs = t2 - t0;
+        visionFrames++;
+
+        // 超時的結果已過時，不套用；持續超時會由 loop() 的逾時保護停車
+        if (t2 - t0 > VISION_BUDGET_US) {
+            visionOverruns++;
+            continue;
+        }
+        applyLineResult(line, cfg);
+    }
+}
+
+void startVisionTask() {
+    // 固定在 core 0、與 loop() 同優先權 (1)，JPEG 解碼不會搶走馬達 ramp 與 Web Server 的時間
+    // (loop() 跑在 CONFIG_ARDUINO_RUNNING_CORE=1；單核設定下兩者以同優先權輪流執行)
+    xTaskCreatePinnedToCore(visionTask, "vision", 8192, NULL, 1, NULL, 0);
+    Serial.println("✅ Vision Task Started");
+}
+
+// ==========================================
+// 3.6 多車頻寬排程 (mDNS 廣播 + 協同限速)
+// ==========================================
+// 每台車以 _viberacer._tcp 廣播串流服務，TXT 記錄目前的需求、位元率與排程設定；
+// 定期查詢同網段的其他車，合併所有車的設定後以相同演算法算出自己的配額並限制串流速率。
+const char* MDNS_SERVICE = "viberacer";
+// 同網段超過此數量的車不支援正常排程：各車改為平分預算 (見 airtimeTask)
+const int AIRTIME_MAX_CARS = 16;
+const unsigned long AIRTIME_PERIOD_MS = 5000;      // 探索週期
+const unsigned long MDNS_QUERY_TIMEOUT_MS = 3000;  // MDNS.queryService() 內部的查詢逾時
+// 網頁搖桿只在拖曳時送出 /control，時間窗須涵蓋一整輪排程，被駕駛權重才不會逐輪跳動
+const unsigned long DRIVEN_WINDOW_MS = airtime::drivenWindowMs(AIRTIME_PERIOD_MS, MDNS_QUERY_TIMEOUT_MS);
+
+// --- /airtime 參數範圍 ---
+const uint32_t AIRTIME_MIN_BUDGET_KBPS = 500;
+const uint32_t AIRTIME_MAX_BUDGET_KBPS = 100000;
+const uint32_t AIRTIME_MAX_WEIGHT = 16;
+
+airtime::SchedulerConfig_t airtimeConfig;
+portMUX_TYPE airtimeConfigMux = portMUX_INITIALIZER_UNLOCKED; // /airtime 寫入、airtimeTask 讀取
+volatile int airtimePeers = 0;    // 最後一次探索到的其他車數量
+volatile uint32_t airtimeSharedBudgetKbps = 0; // 最後一次排程採用的共用預算 (所有車設定的最小值)
+
+// 預算足夠讓 AIRTIME_MAX_CARS 台車都拿到保底，配額就不會被分成 0
+bool isValidAirtimeConfig(const airtime::SchedulerConfig_t& cfg) {
+    return cfg.budgetKbps >= AIRTIME_MIN_BUDGET_KBPS && cfg.budgetKbps <= AIRTIME_MAX_BUDGET_KBPS
+        && cfg.minKbps <= cfg.budgetKbps / AIRTIME_MAX_CARS
+        && cfg.drivenWeight >= 1 && cfg.drivenWeight <= AIRTIME_MAX_WEIGHT;
+}
+
+airtime::SchedulerConfig_t getAirtimeConfig() {
+    taskENTER_CRITICAL(&airtimeConfigMux);
+    airtime::SchedulerConfig_t cfg = airtimeConfig;
+    taskEXIT_CRITICAL(&airtimeConfigMux);
+    return cfg;
+}
+
+void loadAirtimeConfig() {
+    airtime::SchedulerConfig_t defaultConfig = {
+        .budgetKbps = 12000, .minKbps = 300, .drivenWeight = 3
+    };
+
+    preferences.begin("airtime-config", true);
+    size_t size = preferences.getBytes("config", &airtimeConfig, sizeof(airtime::SchedulerConfig_t));
+    preferences.end();
+
+    if (size != sizeof(airtime::SchedulerConfig_t) || !isValidAirtimeConfig(airtimeConfig)) airtimeConfig = defaultConfig;
+}
+
+void saveAirtimeConfig(const airtime::SchedulerConfig_t& cfg) {
+    taskENTER_CRITICAL(&airtimeConfigMux);
+    airtimeConfig = cfg;
+    taskEXIT_CRITICAL(&airtimeConfigMux);
+
+    preferences.begin("airtime-config", false);
+    preferences.putBytes("config", &cfg, sizeof(airtime::SchedulerConfig_t));
+    preferences.end();
+}
+
+bool isDriven() {
+    return !autoMode && airtime::isDrivenAt(millis(), lastDriveTime, DRIVEN_WINDOW_MS);
+}
+
+// 沒有觀看者時只保留 minKbps 待機頻寬，其餘讓給其他車
+uint32_t streamDemandKbps() {
+    uint32_t measured = streamFrameBytes * 8 * airtime::STREAM_MAX_FPS / 1000;
+    return airtime::scheduledDemand(getAirtimeConfig(), streamClients > 0, measured);
+}
+
+void updateMdnsTxt(const airtime::CarDemand_t& self, const airtime::SchedulerConfig_t& cfg) {
+    MDNS.addServiceTxt(MDNS_SERVICE, "tcp", "budget", String(cfg.budgetKbps));
+    MDNS.addServiceTxt(MDNS_SERVICE, "tcp", "min", String(cfg.minKbps));
+    MDNS.addServiceTxt(MDNS_SERVICE, "tcp", "weight", String(cfg.drivenWeight));
+    MDNS.addServiceTxt(MDNS_SERVICE, "tcp", "demand", String(self.demandKbps));
+    MDNS.addServiceTxt(MDNS_SERVICE, "tcp", "driven", self.driven ? "1" : "0");
+    MDNS.addServiceTxt(MDNS_SERVICE, "tcp", "rate", String(streamClients > 0 ? streamRateKbps : 0));
+    MDNS.addServiceTxt(MDNS_SERVICE, "tcp", "cap", String(streamCapKbps));
+}
+
+void airtimeTask(void* param) {
+    airtime::CarDemand_t cars[AIRTIME_MAX_CARS];
+    uint32_t caps[AIRTIME_MAX_CARS];
+
+    while (true) {
+        // cars[0] 固定為自己；本輪以廣播出去的同一份數值排程，其他車看到的也是這份
+        airtime::SchedulerConfig_t own = getAirtimeConfig();
+        airtime::CarDemand_t self = { streamDemandKbps(), isDriven() };
+        cars[0] = self;
+        updateMdnsTxt(self, own);
+
+        // 合併所有車廣播的設定，缺少或不合法的設定 (例如舊版韌體) 不參與合併
+        airtime::SchedulerConfig_t cfg = own;
+        int count = 1;
+        int total = 1;
+        int n = MDNS.queryService(MDNS_SERVICE, "tcp"); // 阻塞直到查詢逾時
+        for (int i = 0; i < n; i++) {
+            if (MDNS.hostname(i) == globalHostname) continue;
+            airtime::SchedulerConfig_t peerCfg = {
+                .budgetKbps = (uint32_t)MDNS.txt(i, "budget").toInt(),
+                .minKbps = (uint32_t)MDNS.txt(i, "min").toInt(),
+                .drivenWeight = (uint32_t)MDNS.txt(i, "weight").toInt()
+            };
+            if (isValidAirtimeConfig(peerCfg)) airtime::mergeConfig(cfg, peerCfg);
+            total++;
+            if (count < AIRTIME_MAX_CARS) {
+                cars[count].demandKbps = MDNS.txt(i, "demand").toInt();
+                cars[count].driven = MDNS.txt(i, "driven") == "1";
+                count++;
+            }
+        }
+        airtimePeers = total - 1;
+        airtimeSharedBudgetKbps = cfg.budgetKbps;
+
+        // 查詢期間的狀態變化 (例如新觀看者連線) 留到下一輪廣播後再排程
+        if (total > AIRTIME_MAX_CARS) {
+            // 查詢結果的順序各車不同，截斷後排程的子集合不一致；超過上限時改為平分預算
+            streamCapKbps = min(self.demandKbps, cfg.budgetKbps / (uint32_t)total);
+        } else if (count == 1) {
+            // 沒有其他車時不必讓出頻寬，只受總預算限制 (待機時的 minKbps 不可拖慢新觀看者)
+            streamCapKbps = cfg.budgetKbps;
+        } else {
+            airtime::allocate(cfg, cars, count, caps);
+            streamCapKbps = caps[0];
+        }
+        streamScheduled = true;
+
+        // 第一位觀看者連線時 stream_handler 會提早喚醒，立即開始下一輪
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(AIRTIME_PERIOD_MS));
+    }
+}
+
+void startMdns() {
+    if (!MDNS.begin(globalHostname.c_str())) {
+        Serial.println("❌ mDNS Start Failed");
+        return;
+    }
+    MDNS.addService("http", "tcp", 80);
+    MDNS.addService(MDNS_SERVICE, "tcp", 81);
+    MDNS.addServiceTxt(MDNS_SERVICE, "tcp", "stream", "/stream");
+    MDNS.addServiceTxt(MDNS_SERVICE, "tcp", "control", "/control");
+    updateMdnsTxt({ streamDemandKbps(), isDriven() }, getAirtimeConfig());
+
+    xTaskCreate(airtimeTask, "airtime", 4096, NULL, 1, &airtimeTaskHandle);
+    Serial.printf("✅ mDNS Started: %s.local\n", globalHostname.c_str());
+}
+
 // ==========================================
 // 4. HTML 網頁 (FPV 風格)
 // ==========================================
@@ -278,7 +659,8 @@ const char* HTML_CONTENT = R"rawliteral(
         <div class="info-bar">
             Host: <span id="hostname">%HOSTNAME%</span><br>
             IP: <span id="ipaddress">%IPADDRESS%</span><br>
-            Status: <span id="status">Ready</span>
+            Status: <span id="status">Ready</span><br>
+            <button id="autoBtn" onclick="toggleAuto()">AUTO: OFF</button>
         </div>
         
         <div id="stickL" class="stick-zone"><div class="knob"></div></div>
@@ -359,12 +741,27 @@ const char* HTML_CONTENT = R"rawliteral(
         }
 
         let motorT = 0, motorS = 0;
+        let autoOn = false;
+
+        function setAutoLabel(on) {
+            autoOn = on;
+            document.getElementById('autoBtn').innerText = `AUTO: ${on ? 'ON' : 'OFF'}`;
+        }
+
+        function toggleAuto() {
+            fetch(`${baseIp}/auto?enable=${autoOn ? 0 : 1}`, { method: 'POST' })
+                .then(r => r.json()).then(j => setAutoLabel(j.enabled)).catch(()=>{});
+        }
 
         function sendControl() {
              fetch(`${baseIp}/control?t=${motorT}&s=${motorS}`).catch(()=>{});
+             setAutoLabel(false); // 手動控制會接管自動模式
              document.getElementById('status').innerText = `T:${motorT} S:${motorS}`;
         }
 
+        // 重新載入頁面時，按鈕顯示車上目前的模式
+        fetch(`${baseIp}/auto`).then(r => r.json()).then(j => setAutoLabel(j.enabled)).catch(()=>{});
+
         // 綁定搖桿
         setupJoystick('stickL', (val) => {
             if(motorS !== val) { motorS = val; sendControl(); }
@@ -485,9 +882,8 @@ void handleControl() {
     if (server.hasArg("t") && server.hasArg("s")) {
         int rawT = server.arg("t").toInt();
         int rawS = server.arg("s").toInt();
-        targetSpeedT = constrain(rawT, -motorConfig.pwmEffectiveLimitT, motorConfig.pwmEffectiveLimitT); 
-        targetSpeedS = constrain(rawS, -motorConfig.pwmEffectiveLimitS, motorConfig.pwmEffectiveLimitS);
-        lastControlTime = millis();
+        setManualControl(constrain(rawT, -motorConfig.pwmEffectiveLimitT, motorConfig.pwmEffectiveLimitT),
+                         constrain(rawS, -motorConfig.pwmEffectiveLimitS, motorConfig.pwmEffectiveLimitS)); // 手動控制接管
         server.send(200, "text/plain", "OK"); 
     } else {
         server.send(400, "text/plain", "Bad Request");
@@ -506,10 +902,78 @@ void handleMotorConfig() {
     }
 }
 
+void handleAuto() {
+    if (server.method() == HTTP_POST) {
+        AutoConfig_t cfg = getAutoConfig();
+        if (server.hasArg("speed")) cfg.cruiseSpeed = server.arg("speed").toInt();
+        if (server.hasArg("min")) cfg.minSpeed = server.arg("min").toInt();
+        if (server.hasArg("gain")) cfg.steerGain = server.arg("gain").toFloat();
+        if (server.hasArg("bias")) cfg.thresholdBias = server.arg("bias").toInt();
+        if (server.hasArg("dark")) cfg.darkLine = server.arg("dark").toInt() != 0;
+        if (server.hasArg("swar")) cfg.useSwar = server.arg("swar").toInt() != 0;
+        setAutoConfig(cfg);
+        if (server.hasArg("enable")) setAutoMode(server.arg("enable").toInt() != 0);
+    }
+    AutoConfig_t cfg = getAutoConfig();
+    String json = "{\"enabled\":" + String(autoMode ? "true" : "false") +
+                  ",\"speed\":" + String(cfg.cruiseSpeed) +
+                  ",\"min\":" + String(cfg.minSpeed) +
+                  ",\"gain\":" + String(cfg.steerGain, 2) +
+                  ",\"bias\":" + String(cfg.thresholdBias) +
+                  ",\"dark\":" + String(cfg.darkLine ? "true" : "false") +
+                  ",\"swar\":" + String(cfg.useSwar ? "true" : "false") +
+                  ",\"found\":" + String(visionLineFound ? "true" : "false") +
+                  ",\"offset\":" + String(visionOffset, 3) +
+                  ",\"frames\":" + String(visionFrames) +
+                  ",\"overruns\":" + String(visionOverruns) +
+                  ",\"waitUs\":" + String(visionWaitUs) +
+                  ",\"decodeUs\":" + String(visionDecodeUs) +
+                  ",\"kernelUs\":" + String(visionKernelUs) +
+                  ",\"totalUs\":" + String(visionTotalUs) +
+                  ",\"budgetUs\":" + String(VISION_BUDGET_US) + "}";
+    server.send(200, "application/json", json);
+}
+
+void handleAirtime() {
+    if (server.method() == HTTP_POST) {
+        // 先以有號數解析，負數不可直接存入 uint32_t
+        airtime::SchedulerConfig_t cfg = getAirtimeConfig();
+        long budget = server.hasArg("budget") ? server.arg("budget").toInt() : (long)cfg.budgetKbps;
+        long minKbps = server.hasArg("min") ? server.arg("min").toInt() : (long)cfg.minKbps;
+        long weight = server.hasArg("weight") ? server.arg("weight").toInt() : (long)cfg.drivenWeight;
+        if (budget < 0 || minKbps < 0 || weight < 0) {
+            server.send(400, "text/plain", "Bad Request");
+            return;
+        }
+        cfg.budgetKbps = budget;
+        cfg.minKbps = minKbps;
+        cfg.drivenWeight = weight;
+        if (!isValidAirtimeConfig(cfg)) {
+            server.send(400, "text/plain", "Bad Request");
+            return;
+        }
+        saveAirtimeConfig(cfg);
+    }
+    airtime::SchedulerConfig_t cfg = getAirtimeConfig();
+    String json = "{\"budgetKbps\":" + String(cfg.budgetKbps) +
+                  ",\"minKbps\":" + String(cfg.minKbps) +
+                  ",\"drivenWeight\":" + String(cfg.drivenWeight) +
+                  ",\"sharedBudgetKbps\":" + String(airtimeSharedBudgetKbps) +
+                  ",\"peers\":" + String(airtimePeers) +
+                  ",\"driven\":" + String(isDriven() ? "true" : "false") +
+                  ",\"demandKbps\":" + String(streamDemandKbps()) +
+                  ",\"scheduled\":" + String(streamScheduled ? "true" : "false") +
+                  ",\"capKbps\":" + String(streamCapKbps) +
+                  ",\"rateKbps\":" + String(streamRateKbps) + "}";
+    server.send(200, "application/json", json);
+}
+
 void setupWebServer() {
     server.on("/", HTTP_GET, handleRoot);
     server.on("/control", HTTP_GET, handleControl);
     server.on("/config", HTTP_ANY, handleMotorConfig);
+    server.on("/auto", HTTP_ANY, handleAuto);
+    server.on("/airtime", HTTP_ANY, handleAirtime);
     server.onNotFound([](){ server.send(404); });
     server.begin();
     Serial.println("HTTP Server Started (Port 80)");
@@ -547,9 +1011,8 @@ class MyCharacteristicCallbacks: public BLECharacteristicCallbacks {
             String command = String(rxValue.c_str());
             int commaIndex = command.indexOf(',');
             if (commaIndex > 0) {
-                targetSpeedT = command.substring(0, commaIndex).toInt();
-                targetSpeedS = command.substring(commaIndex + 1).toInt();
-                lastControlTime = millis(); 
+                setManualControl(command.substring(0, commaIndex).toInt(),
+                                 command.substring(commaIndex + 1).toInt()); // 手動控制接管
             }
         }
     }
@@ -600,10 +1063,12 @@ void setup() {
     
     // 0. 載入設定
     loadMotorConfig();
+    loadAirtimeConfig();
 
     // 1. 初始化相機 (S3 優先初始化相機以配置 PSRAM)
     if(initCamera()) {
         Serial.println("✅ Camera Initialized");
+        startVisionTask(); // 預設待機，由 /auto 啟用
     } else {
         Serial.println("❌ Camera Failed");
     }
@@ -630,9 +1095,11 @@ void setup() {
 
 void loop() {
     // 1. 安全檢查
+    taskENTER_CRITICAL(&controlMux);
     if ((targetSpeedT != 0 || targetSpeedS != 0) && (millis() - lastControlTime > motorConfig.controlTimeoutMs)) {
         targetSpeedT = 0; targetSpeedS = 0;
     }
+    taskEXIT_CRITICAL(&controlMux);
 
     // 2. BLE 重連
     if (should_restart_advertising) {
@@ -644,6 +1111,8 @@ void loop() {
     if (WiFi.status() == WL_CONNECTED && !servicesStarted) {
         setupWebServer();
         startCameraServer(); // 啟動影像串流
+        startMdns();         // 廣播服務並啟動頻寬排程 (須在 OTA 之前，OTA 會沿用同一個 mDNS)
+        ArduinoOTA.setHostname(globalHostname.c_str());
         ArduinoOTA.begin();
         servicesStarted = true;
         Serial.printf("IP: %s\n", WiFi.localIP().toString().c_str());
@@ -0,0 +1,405 @@
+// 多車頻寬排程測試與 loopback 模擬 (pio test -e native)
+#include <unity.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include "airtime_scheduler.h"
+
+using namespace airtime;
+
+static const SchedulerConfig_t CFG = { .budgetKbps = 12000, .minKbps = 300, .drivenWeight = 3 }; // main.cpp 預設值
+static const uint32_t VGA_DEMAND_KBPS = 4800;
+static const uint32_t PERIOD_MS = 5000, QUERY_TIMEOUT_MS = 3000; // main.cpp AIRTIME_PERIOD_MS / MDNS_QUERY_TIMEOUT_MS
+
+static uint32_t sum(const std::vector<uint32_t>& v) {
+    uint32_t s = 0;
+    for (uint32_t x : v) s += x;
+    return s;
+}
+
+static std::vector<uint32_t> allocateAll(const std::vector<CarDemand_t>& cars) {
+    std::vector<uint32_t> caps(cars.size());
+    allocate(CFG, cars.data(), (int)cars.size(), caps.data());
+    return caps;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// ==========================================
+// allocate() 性質
+// ==========================================
+void test_caps_within_budget() {
+    for (int n = 1; n <= 8; n++) {
+        std::vector<CarDemand_t> cars(n, CarDemand_t{ VGA_DEMAND_KBPS, false });
+        cars[0].driven = true;
+        std::vector<uint32_t> caps = allocateAll(cars);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(CFG.budgetKbps, sum(caps));
+        for (int i = 0; i < n; i++) TEST_ASSERT_LESS_OR_EQUAL_UINT32(VGA_DEMAND_KBPS, caps[i]);
+    }
+}
+
+void test_budget_too_small_for_floors() {
+    SchedulerConfig_t tiny = { .budgetKbps = 1000, .minKbps = 300, .drivenWeight = 3 };
+    std::vector<CarDemand_t> cars(8, CarDemand_t{ VGA_DEMAND_KBPS, false });
+    std::vector<uint32_t> caps(8);
+    allocate(tiny, cars.data(), 8, caps.data());
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(tiny.budgetKbps, sum(caps));
+    for (uint32_t c : caps) TEST_ASSERT_EQUAL_UINT32(tiny.budgetKbps / 8, c);
+}
+
+void test_driven_car_has_priority() {
+    for (int n = 2; n <= 8; n++) {
+        std::vector<CarDemand_t> cars(n, CarDemand_t{ VGA_DEMAND_KBPS, false });
+        cars[n - 1].driven = true;
+        std::vector<uint32_t> caps = allocateAll(cars);
+        bool saturated = n * VGA_DEMAND_KBPS > CFG.budgetKbps;
+        for (int i = 0; i < n - 1; i++) {
+            if (saturated) TEST_ASSERT_GREATER_THAN_UINT32(caps[i], caps[n - 1]);
+            else TEST_ASSERT_EQUAL_UINT32(caps[i], caps[n - 1]);
+        }
+    }
+}
+
+// 每台車都把自己排在第一位：任何排列順序都必須得到相同的配額
+void test_order_independent() {
+    std::mt19937 rng(42);
+    for (int n = 1; n <= 8; n++) {
+        for (int trial = 0; trial < 50; trial++) {
+            std::vector<CarDemand_t> cars(n);
+            for (int i = 0; i < n; i++) {
+                cars[i].demandKbps = rng() % 8000; // 含低於 minKbps 的需求
+                cars[i].driven = (rng() % 4) == 0;
+            }
+            std::vector<uint32_t> reference = allocateAll(cars);
+
+            std::vector<int> order(n);
+            for (int i = 0; i < n; i++) order[i] = i;
+            for (int shuffle = 0; shuffle < 10; shuffle++) {
+                std::shuffle(order.begin(), order.end(), rng);
+                std::vector<CarDemand_t> permuted(n);
+                for (int i = 0; i < n; i++) permuted[i] = cars[order[i]];
+                std::vector<uint32_t> caps = allocateAll(permuted);
+                for (int i = 0; i < n; i++) TEST_ASSERT_EQUAL_UINT32(reference[order[i]], caps[i]);
+            }
+        }
+    }
+}
+
+// 沒有觀看者的車廣播與排程都用 minKbps，其他車算出的結果與它自己一致
+void test_idle_car_reserves_floor() {
+    uint32_t idle = scheduledDemand(CFG, false, 0);
+    TEST_ASSERT_EQUAL_UINT32(CFG.minKbps, idle);
+    TEST_ASSERT_EQUAL_UINT32(CFG.minKbps, scheduledDemand(CFG, true, 0)); // 尚未量到畫面大小
+    TEST_ASSERT_EQUAL_UINT32(VGA_DEMAND_KBPS, scheduledDemand(CFG, true, VGA_DEMAND_KBPS));
+
+    std::vector<CarDemand_t> cars(4, CarDemand_t{ VGA_DEMAND_KBPS, false });
+    cars[2].demandKbps = idle;
+    std::vector<uint32_t> caps = allocateAll(cars);
+    TEST_ASSERT_EQUAL_UINT32(CFG.minKbps, caps[2]);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(CFG.budgetKbps, sum(caps));
+}
+
+// 各車以 /airtime 設定不同的預算：合併廣播的設定後，
+// 每台車 (自己排第一) 算出的配額一致，總和不超過最小的預算
+void test_mismatched_configs_agree() {
+    std::mt19937 rng(3);
+    for (int n = 2; n <= 8; n++) {
+        for (int trial = 0; trial < 50; trial++) {
+            std::vector<SchedulerConfig_t> cfgs(n);
+            std::vector<CarDemand_t> cars(n);
+            uint32_t smallestBudget = 0xFFFFFFFFu;
+            for (int i = 0; i < n; i++) {
+                cfgs[i].budgetKbps = 500 + rng() % 20000;
+                cfgs[i].minKbps = rng() % (cfgs[i].budgetKbps / 16 + 1); // main.cpp isValidAirtimeConfig
+                cfgs[i].drivenWeight = 1 + rng() % 16;
+                cars[i] = CarDemand_t{ (uint32_t)(rng() % 8000), (rng() % 4) == 0 };
+                smallestBudget = std::min(smallestBudget, cfgs[i].budgetKbps);
+            }
+
+            std::vector<uint32_t> reference;
+            for (int self = 0; self < n; self++) {
+                // 自己排第一，其餘依查詢順序 (此處以輪轉代表不同順序)
+                std::vector<int> order(n);
+                for (int i = 0; i < n; i++) order[i] = (self + i) % n;
+                SchedulerConfig_t merged = cfgs[order[0]];
+                std::vector<CarDemand_t> seen(n);
+                for (int i = 0; i < n; i++) {
+                    if (i > 0) mergeConfig(merged, cfgs[order[i]]);
+                    seen[i] = cars[order[i]];
+                }
+                TEST_ASSERT_EQUAL_UINT32(smallestBudget, merged.budgetKbps);
+                TEST_ASSERT_LESS_OR_EQUAL_UINT32(merged.budgetKbps / 16, merged.minKbps);
+
+                std::vector<uint32_t> caps(n), byId(n);
+                allocate(merged, seen.data(), n, caps.data());
+                for (int i = 0; i < n; i++) byId[order[i]] = caps[i];
+                if (self == 0) reference = byId;
+                for (int i = 0; i < n; i++) TEST_ASSERT_EQUAL_UINT32(reference[i], byId[i]);
+            }
+            TEST_ASSERT_LESS_OR_EQUAL_UINT32(smallestBudget, sum(reference));
+        }
+    }
+}
+
+void test_frame_interval() {
+    // 小畫面只受 FPS 上限限制
+    TEST_ASSERT_EQUAL_UINT32(1000000 / STREAM_MAX_FPS, frameIntervalUs(1000, 12000, STREAM_MAX_FPS));
+    // VGA 畫面剛好在 4800 kbps 時兩個限制相同
+    TEST_ASSERT_EQUAL_UINT32(50000, frameIntervalUs(30000, VGA_DEMAND_KBPS, STREAM_MAX_FPS));
+    // 配額較小時依位元數 / 配額
+    TEST_ASSERT_EQUAL_UINT32(200000, frameIntervalUs(30000, 1200, STREAM_MAX_FPS));
+    TEST_ASSERT_EQUAL_UINT32(800000, frameIntervalUs(30000, CFG.minKbps, STREAM_MAX_FPS));
+    // 配額 0 視為 1 kbps，不是不限速
+    TEST_ASSERT_EQUAL_UINT32(30000u * 8 * 1000, frameIntervalUs(30000, 0, STREAM_MAX_FPS));
+    // 溢位時飽和
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu, frameIntervalUs(0xFFFFFFFFu, 0, STREAM_MAX_FPS));
+}
+
+// 網頁搖桿只在拖曳時每 100 ms 送出 /control；排程每輪只取樣一次被駕駛狀態。
+// 上一輪取樣後只要有過控制，這一輪就必須視為被駕駛，持續駕駛時不可逐輪跳動。
+void test_driven_flag_holds_for_a_round() {
+    const uint32_t window = drivenWindowMs(PERIOD_MS, QUERY_TIMEOUT_MS);
+    std::mt19937 rng(7);
+    for (int trial = 0; trial < 200; trial++) {
+        // 起點靠近 uint32_t 上限，涵蓋 millis() 溢位
+        uint32_t t = (trial % 2) ? 0xFFFFFFFFu - 20000 : 1000;
+        uint32_t lastControl = 0;
+        uint32_t nextSample = t + PERIOD_MS + QUERY_TIMEOUT_MS;
+        bool controlledSinceSample = false;
+        for (int step = 0; step < 2000; step++) {
+            // 每 100 ms：有一定機率正在拖曳搖桿 (短暫的一下)
+            t += 100;
+            if (rng() % 40 == 0) {
+                lastControl = t ? t : 1;
+                controlledSinceSample = true;
+            }
+            if ((int32_t)(t - nextSample) >= 0) {
+                bool driven = isDrivenAt(t, lastControl, window);
+                if (controlledSinceSample) TEST_ASSERT_TRUE(driven);
+                if (driven) TEST_ASSERT_LESS_THAN_UINT32(window, t - lastControl);
+                controlledSinceSample = false;
+                // 一輪 = 週期 + 查詢 (0 ~ 逾時) + 少許排程延遲
+                nextSample = t + PERIOD_MS + rng() % (QUERY_TIMEOUT_MS + 1) + rng() % 500;
+            }
+        }
+    }
+
+    TEST_ASSERT_FALSE(isDrivenAt(12345, 0, window));               // 從未控制
+    TEST_ASSERT_TRUE(isDrivenAt(5, 0xFFFFFFF0u, window));           // millis() 溢位
+    TEST_ASSERT_FALSE(isDrivenAt(1000 + window, 1000, window));
+}
+
+// ==========================================
+// Linux loopback 多實例模擬
+// ==========================================
+// 每台車是一個執行緒：以 UDP 在 127.0.0.1 上互相交換廣播記錄 (代替 mDNS TXT)，
+// 各自以 allocate() 算出配額，再用與 main.cpp paceStream 相同的規則，
+// 以 TCP 串流假畫面到接收端。接收端量測總吞吐量。
+#ifndef _WIN32
+static const int SIM_FRAME_BYTES = 30000;    // 30 KB x 20 fps = 4800 kbps，與 VGA 需求相同
+static const int SIM_STREAM_MS = 3000;
+
+typedef struct {
+    int id;
+    uint32_t demandKbps;
+    int driven;
+} SimRecord_t;
+
+typedef struct {
+    int id;
+    bool driven;
+    int udpFd;
+    uint16_t udpPort;
+    uint32_t capKbps;
+    std::vector<uint32_t> view;   // 這台車算出的所有車配額 (依 id)
+} SimCar_t;
+
+static int openUdp(uint16_t* port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    bind(fd, (sockaddr*)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    *port = ntohs(addr.sin_port);
+    timeval tv = { 2, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+// 廣播自己的記錄並收集其他車的記錄，自己排在第一位後排程
+static void discoverAndSchedule(SimCar_t& car, const std::vector<SimCar_t>& all) {
+    SimRecord_t self = { car.id, scheduledDemand(CFG, true, VGA_DEMAND_KBPS), car.driven ? 1 : 0 };
+    for (const SimCar_t& peer : all) {
+        if (peer.id == car.id) continue;
+        sockaddr_in to = {};
+        to.sin_family = AF_INET;
+        to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        to.sin_port = htons(peer.udpPort);
+        sendto(car.udpFd, &self, sizeof(self), 0, (sockaddr*)&to, sizeof(to));
+    }
+
+    std::vector<CarDemand_t> cars(1, CarDemand_t{ self.demandKbps, self.driven != 0 });
+    std::vector<int> ids(1, car.id);
+    while (cars.size() < all.size()) {
+        SimRecord_t rec;
+        if (recv(car.udpFd, &rec, sizeof(rec), 0) != (ssize_t)sizeof(rec)) break;
+        cars.push_back(CarDemand_t{ rec.demandKbps, rec.driven != 0 });
+        ids.push_back(rec.id);
+    }
+
+    std::vector<uint32_t> caps(cars.size());
+    allocate(CFG, cars.data(), (int)cars.size(), caps.data());
+    car.capKbps = caps[0];
+    car.view.assign(all.size(), 0);
+    for (size_t i = 0; i < ids.size(); i++) car.view[ids[i]] = caps[i];
+}
+
+// 與 main.cpp paceStream 相同，以 frameIntervalUs 決定畫面間隔。
+// 只送出整個間隔都落在期限內的畫面，量到的吞吐量不會因最後一張畫面而高估。
+static void streamPaced(uint32_t capKbps, uint16_t sinkPort, std::chrono::steady_clock::time_point deadline) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    to.sin_port = htons(sinkPort);
+    if (connect(fd, (sockaddr*)&to, sizeof(to)) != 0) {
+        close(fd);
+        return;
+    }
+
+    std::vector<uint8_t> frame(SIM_FRAME_BYTES, 0x55);
+    auto interval = std::chrono::microseconds(frameIntervalUs(SIM_FRAME_BYTES, capKbps, STREAM_MAX_FPS));
+    auto frameStart = std::chrono::steady_clock::now();
+    while (frameStart + interval <= deadline) {
+        if (send(fd, frame.data(), frame.size(), 0) != (ssize_t)frame.size()) break;
+        std::this_thread::sleep_until(frameStart + interval);
+        frameStart += interval;
+    }
+    close(fd);
+}
+
+// 回傳總吞吐量 (kbps)
+static uint32_t simulate(int n, std::vector<SimCar_t>& cars) {
+    cars.assign(n, SimCar_t());
+    for (int i = 0; i < n; i++) {
+        cars[i].id = i;
+        cars[i].driven = (i == 0);
+        cars[i].udpFd = openUdp(&cars[i].udpPort);
+    }
+
+    // 接收端
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listenFd, (sockaddr*)&addr, sizeof(addr));
+    listen(listenFd, n);
+    socklen_t len = sizeof(addr);
+    getsockname(listenFd, (sockaddr*)&addr, &len);
+    uint16_t sinkPort = ntohs(addr.sin_port);
+
+    std::atomic<uint64_t> received(0);
+    std::vector<std::thread> readers;
+    std::thread acceptor([&]() {
+        for (int i = 0; i < n; i++) {
+            int fd = accept(listenFd, NULL, NULL);
+            if (fd < 0) break;
+            readers.emplace_back([fd, &received]() {
+                uint8_t buf[8192];
+                ssize_t r;
+                while ((r = recv(fd, buf, sizeof(buf), 0)) > 0) received += (uint64_t)r;
+                close(fd);
+            });
+        }
+    });
+
+    // 探索 → 排程 → 串流
+    auto start = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    auto deadline = start + std::chrono::milliseconds(SIM_STREAM_MS);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < n; i++) {
+        threads.emplace_back([&, i]() {
+            discoverAndSchedule(cars[i], cars);
+            std::this_thread::sleep_until(start);
+            streamPaced(cars[i].capKbps, sinkPort, deadline);
+        });
+    }
+    for (std::thread& t : threads) t.join();
+    acceptor.join();
+    for (std::thread& t : readers) t.join();
+    close(listenFd);
+    for (SimCar_t& car : cars) close(car.udpFd);
+
+    return (uint32_t)(received.load() * 8 / SIM_STREAM_MS);
+}
+
+void test_loopback_simulation() {
+    std::vector<uint32_t> aggregate(9, 0);
+    for (int n = 1; n <= 8; n++) {
+        std::vector<SimCar_t> cars;
+        aggregate[n] = simulate(n, cars);
+
+        // 每台車各自算出的整體配額必須一致，且總和不超過預算
+        for (int i = 1; i < n; i++) {
+            for (int j = 0; j < n; j++) TEST_ASSERT_EQUAL_UINT32(cars[0].view[j], cars[i].view[j]);
+        }
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(CFG.budgetKbps, sum(cars[0].view));
+        for (int i = 1; i < n; i++) TEST_ASSERT_GREATER_OR_EQUAL_UINT32(cars[i].capKbps, cars[0].capKbps);
+
+        char msg[96];
+        snprintf(msg, sizeof(msg), "%d cars: aggregate %u kbps, driven cap %u kbps, others %u kbps",
+                 n, aggregate[n], cars[0].capKbps, n > 1 ? cars[1].capKbps : 0);
+        TEST_MESSAGE(msg);
+
+        // 實測吞吐量：不超過預算 (容許 5% 量測誤差)，且接近 min(總需求, 預算)
+        uint32_t expected = std::min<uint32_t>(n * VGA_DEMAND_KBPS, CFG.budgetKbps);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(CFG.budgetKbps * 105 / 100, aggregate[n]);
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(expected * 80 / 100, aggregate[n]);
+    }
+
+    // 飽和後 (3 台以上) 車數增加，總吞吐量維持穩定
+    uint32_t lo = *std::min_element(aggregate.begin() + 3, aggregate.end());
+    uint32_t hi = *std::max_element(aggregate.begin() + 3, aggregate.end());
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(lo * 115 / 100, hi);
+}
+#else
+void test_loopback_simulation() {
+    TEST_IGNORE_MESSAGE("loopback simulation requires POSIX sockets");
+}
+#endif
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_caps_within_budget);
+    RUN_TEST(test_budget_too_small_for_floors);
+    RUN_TEST(test_driven_car_has_priority);
+    RUN_TEST(test_order_independent);
+    RUN_TEST(test_idle_car_reserves_floor);
+    RUN_TEST(test_mismatched_configs_agree);
+    RUN_TEST(test_frame_interval);
+    RUN_TEST(test_driven_flag_holds_for_a_round);
+    RUN_TEST(test_loopback_simulation);
+    return UNITY_END();
+}
@@ -0,0 +1,195 @@
+// 循線視覺核心 golden 測試與效能量測 (pio test -e native)
+// 測試畫面由 scripts/make_vision_frames.py 產生於 test/data/
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "line_vision.h"
+
+using namespace linevision;
+
+static const int W = 160, H = 120;          // QQVGA：VGA 以 JPG_SCALE_4X 解碼後的大小
+static const int SW = W / 2, SH = H / 2;
+static const int SCAN_ROWS = 8, ROW_STEP = 4; // 與 main.cpp 的 VISION_SCAN_ROWS / VISION_ROW_STEP 相同
+static const int BIAS = 30;
+
+typedef struct {
+    int thr;
+    bool found;
+    float offset;
+    int rows;
+} Golden_t;
+
+static std::vector<uint8_t> readFile(const char* name, const char* ext) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.%s", TEST_DATA_DIR, name, ext);
+    std::vector<uint8_t> data;
+    FILE* f = fopen(path, "rb");
+    if (!f) return data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return data;
+}
+
+static Golden_t readGolden(const char* name) {
+    std::vector<uint8_t> text = readFile(name, "golden");
+    text.push_back('\0');
+    Golden_t g = {0, false, 0.0f, 0};
+    int found = 0;
+    int parsed = sscanf((const char*)text.data(), "thr %d found %d offset %f rows %d", &g.thr, &found, &g.offset, &g.rows);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(4, parsed, name);
+    g.found = found != 0;
+    return g;
+}
+
+// 完整流程：與 main.cpp visionTask 相同的步驟
+static void runPipeline(const char* name, bool swar) {
+    std::vector<uint8_t> rgb = readFile(name, "rgb565");
+    std::vector<uint8_t> goldenSmall = readFile(name, "small");
+    std::vector<uint8_t> goldenMask = readFile(name, "mask");
+    TEST_ASSERT_EQUAL_size_t_MESSAGE(W * H * 2, rgb.size(), name);
+    TEST_ASSERT_EQUAL_size_t_MESSAGE(SW * SH, goldenSmall.size(), name);
+    TEST_ASSERT_EQUAL_size_t_MESSAGE(SW * SH, goldenMask.size(), name);
+    Golden_t g = readGolden(name);
+
+    std::vector<uint8_t> gray(W * H), small(SW * SH), mask(SW * SH);
+    rgb565ToGray(rgb.data(), W * H, gray.data());
+    if (swar) downscale2xSwar(gray.data(), W, H, small.data());
+    else downscale2xScalar(gray.data(), W, H, small.data());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(goldenSmall.data(), small.data(), SW * SH, name);
+
+    int luma = meanLuma(small.data(), SW * SH);
+    int thr = luma - BIAS < 0 ? 0 : luma - BIAS;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(g.thr, thr, name);
+    if (swar) thresholdSwar(small.data(), SW * SH, (uint8_t)thr, true, mask.data());
+    else thresholdScalar(small.data(), SW * SH, (uint8_t)thr, true, mask.data());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(goldenMask.data(), mask.data(), SW * SH, name);
+
+    LineResult_t line = findLine(mask.data(), SW, SH, SCAN_ROWS, ROW_STEP, swar);
+    TEST_ASSERT_EQUAL_MESSAGE(g.found, line.found, name);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(g.rows, line.rowsWithLine, name);
+    TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1e-4f, g.offset, line.offset, name);
+}
+
+void setUp() {}
+void tearDown() {}
+
+// jpg2rgb565 (to_bmp.c _rgb565_write) 輸出低位元組在前
+void test_rgb565_byte_order() {
+    const uint8_t px[] = {
+        0x00, 0xF8, // 紅 0xF800
+        0xE0, 0x07, // 綠 0x07E0
+        0x1F, 0x00, // 藍 0x001F
+    };
+    uint8_t gray[3];
+    rgb565ToGray(px, 3, gray);
+    TEST_ASSERT_EQUAL_UINT8(77 * 248 >> 8, gray[0]);
+    TEST_ASSERT_EQUAL_UINT8(150 * 252 >> 8, gray[1]);
+    TEST_ASSERT_EQUAL_UINT8(29 * 248 >> 8, gray[2]);
+}
+
+void test_golden_straight_scalar() { runPipeline("straight", false); }
+void test_golden_straight_swar() { runPipeline("straight", true); }
+void test_golden_curve_scalar() { runPipeline("curve", false); }
+void test_golden_curve_swar() { runPipeline("curve", true); }
+void test_golden_lost_scalar() { runPipeline("lost", false); }
+void test_golden_lost_swar() { runPipeline("lost", true); }
+
+// 非 4 對齊的寬度與尾端像素：scalar 與 SWAR 必須逐位元相同
+void test_swar_matches_scalar_odd_sizes() {
+    srand(1);
+    for (int it = 0; it < 200; it++) {
+        int w = 2 * (1 + rand() % 45), h = 2 * (1 + rand() % 20);
+        std::vector<uint8_t> src(w * h), a(w * h / 4), b(w * h / 4), ma(w * h), mb(w * h);
+        for (size_t i = 0; i < src.size(); i++) src[i] = (uint8_t)rand();
+
+        downscale2xScalar(src.data(), w, h, a.data());
+        downscale2xSwar(src.data(), w, h, b.data());
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(a.data(), b.data(), a.size());
+
+        uint8_t thr = (uint8_t)rand();
+        bool dark = rand() & 1;
+        thresholdScalar(src.data(), src.size(), thr, dark, ma.data());
+        thresholdSwar(src.data(), src.size(), thr, dark, mb.data());
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(ma.data(), mb.data(), ma.size());
+
+        for (int y = 0; y < h; y++) {
+            RowScan_t rs = rowScanScalar(ma.data() + y * w, w);
+            RowScan_t rv = rowScanSwar(ma.data() + y * w, w);
+            TEST_ASSERT_EQUAL_INT(rs.count, rv.count);
+            TEST_ASSERT_EQUAL_INT32(rs.sumX, rv.sumX);
+        }
+    }
+}
+
+// 效能量測：各核心分別計時 (不含 JPEG 解碼)，只輸出結果，不做門檻判定。
+// 整條流程的時間以沒有 SWAR 版本的 rgb565ToGray 為主，會掩蓋核心之間的差異。
+template <typename F>
+static double benchUs(F kernel, int iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) kernel();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+static void reportBench(const char* kernel, double scalarUs, double swarUs) {
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%-10s scalar %6.2f us  swar %6.2f us  (x%.2f)", kernel, scalarUs, swarUs, scalarUs / swarUs);
+    TEST_MESSAGE(msg);
+}
+
+void test_benchmark_kernels() {
+    std::vector<uint8_t> rgb = readFile("straight", "rgb565");
+    TEST_ASSERT_EQUAL_size_t(W * H * 2, rgb.size());
+    const int iterations = 5000;
+    std::vector<uint8_t> gray(W * H), small(SW * SH), mask(SW * SH);
+    volatile int32_t sink = 0;
+
+    double grayUs = benchUs([&]() { rgb565ToGray(rgb.data(), W * H, gray.data()); }, iterations);
+
+    double downScalarUs = benchUs([&]() { downscale2xScalar(gray.data(), W, H, small.data()); }, iterations);
+    double downSwarUs = benchUs([&]() { downscale2xSwar(gray.data(), W, H, small.data()); }, iterations);
+
+    int luma = meanLuma(small.data(), SW * SH);
+    uint8_t thr = (uint8_t)(luma - BIAS < 0 ? 0 : luma - BIAS);
+    double thrScalarUs = benchUs([&]() { thresholdScalar(small.data(), SW * SH, thr, true, mask.data()); }, iterations);
+    double thrSwarUs = benchUs([&]() { thresholdSwar(small.data(), SW * SH, thr, true, mask.data()); }, iterations);
+
+    // 列掃描：量測整張遮罩的每一列，而非 findLine 只掃的 SCAN_ROWS 列
+    double scanScalarUs = benchUs([&]() {
+        for (int y = 0; y < SH; y++) sink = sink + rowScanScalar(mask.data() + y * SW, SW).sumX;
+    }, iterations);
+    double scanSwarUs = benchUs([&]() {
+        for (int y = 0; y < SH; y++) sink = sink + rowScanSwar(mask.data() + y * SW, SW).sumX;
+    }, iterations);
+    (void)sink;
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "QQVGA %dx%d -> %dx%d, %d iterations", W, H, SW, SH, iterations);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "%-10s %6.2f us (no SWAR version)", "gray", grayUs);
+    TEST_MESSAGE(msg);
+    reportBench("downscale", downScalarUs, downSwarUs);
+    reportBench("threshold", thrScalarUs, thrSwarUs);
+    reportBench("row scan", scanScalarUs, scanSwarUs);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_rgb565_byte_order);
+    RUN_TEST(test_golden_straight_scalar);
+    RUN_TEST(test_golden_straight_swar);
+    RUN_TEST(test_golden_curve_scalar);
+    RUN_TEST(test_golden_curve_swar);
+    RUN_TEST(test_golden_lost_scalar);
+    RUN_TEST(test_golden_lost_swar);
+    RUN_TEST(test_swar_matches_scalar_odd_sizes);
+    RUN_TEST(test_benchmark_kernels);
+    return UNITY_END();
+}